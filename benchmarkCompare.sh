@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+#
+# Times the simulator running benchmarkBinary.txt against benchmarkNative.cpp
+# on the same raw input, and prints how many times slower the simulator is.
+# Run it from the repository root; the List size defaults to 10M values.
+#
+#     ./benchmarkCompare.sh [values]
+#
+
+set -euo pipefail
+
+values=${1:-10000000}
+input=benchmarkInput.bin
+
+g++ -O2 -pthread -o simulator simulator.cpp
+g++ -O2 -o native benchmarkNative.cpp
+./native --write-input "$values" "$input"
+
+if ! diff <(./simulator --raw-input "$input") <(./native --raw-input "$input") > /dev/null; then
+    echo "Error: The simulator and the native program printed different results." >&2
+    exit 1
+fi
+
+# Prints the best of five runs of a command, in nanoseconds
+best() {
+    local best=0
+    for run in 1 2 3 4 5; do
+        local start end
+        start=$(date +%s%N)
+        "$@" > /dev/null
+        end=$(date +%s%N)
+        if (( best == 0 || end - start < best )); then
+            best=$(( end - start ))
+        fi
+    done
+    echo "$best"
+}
+
+simulator=$(best ./simulator --raw-input "$input")
+native=$(best ./native --raw-input "$input")
+rm -f "$input"
+
+awk -v s="$simulator" -v n="$native" -v v="$values" 'BEGIN {
+    printf "Values:    %d\n", v
+    printf "Simulator: %.3f s\n", s / 1e9
+    printf "Native:    %.3f s\n", n / 1e9
+    printf "Slowdown:  %.2fx\n", s / n
+}'
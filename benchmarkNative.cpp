@@ -0,0 +1,152 @@
+/**
+ * @file benchmarkNative.cpp
+ * @brief Hand-written C++ equivalent of benchmark.txt
+ *
+ * Reads and writes exactly what the simulator does when it runs
+ * benchmarkBinary.txt, so both can be timed on the same input and their
+ * outputs compared. The time the simulator takes over this program is its
+ * slowdown against native code.
+ *
+ * With no options it reads text from the keyboard like the simulator does.
+ * Parsing text costs both of them the same, so the slowdown is measured with
+ * --raw-input, which takes the same raw u32 values as the simulator's
+ * --raw-input: the List size, then its elements. --write-input makes such a
+ * file. benchmarkCompare.sh builds both programs, times them on one raw
+ * input file and prints the slowdown:
+ *
+ *     ./benchmarkCompare.sh [values]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * The values are a fixed sequence, so every run of the comparison sums the
+ * same List.
+ *
+ * @brief Writes a raw input file for a List of a given size.
+ *
+ * @param count The number of List elements
+ * @param path The file to write
+ * @return true if the file was written, false otherwise
+ */
+bool writeInput(std::uint32_t count, const std::string &path)
+{
+    std::vector<std::uint32_t> values(count + 1);
+    values[0] = count;
+    for (std::uint32_t i = 1; i <= count; ++i)
+        values[i] = i * 2654435761u;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(std::uint32_t));
+    if (file.fail())
+    {
+        std::cerr << "Error: Could not write raw input file \'" << path << "\'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Maps the file like the simulator does, then copies the elements into a List
+ * and sums them; values missing from the end of the file are 0.
+ *
+ * @brief Runs benchmark.txt on a raw input file.
+ *
+ * @param path The raw input file
+ * @return true if the file could be read, false otherwise
+ */
+bool runRaw(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        std::cerr << "Error: Could not open raw input file \'" << path << "\'." << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void *memory = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "Error: Could not map raw input file \'" << path << "\'." << std::endl;
+        return false;
+    }
+    const auto *values = static_cast<const std::uint32_t *>(memory);
+    std::size_t available = size / sizeof(std::uint32_t);
+
+    // In __REG_2
+    std::uint32_t amount = available > 0 ? values[0] : 0;
+
+    // List @__REG_2 __REG_3, ListInit __REG_3
+    std::vector<unsigned int> array(amount);
+    std::size_t copied = std::min<std::size_t>(amount, available > 0 ? available - 1 : 0);
+    if (copied > 0)
+        std::memcpy(array.data(), values + 1, copied * sizeof(std::uint32_t));
+
+    // ListSum __REG_3 __REG_4
+    unsigned int sum{0};
+    for (unsigned int value : array)
+        sum += value;
+
+    // Out __REG_4, Stop
+    std::cout << sum << "\n"
+              << "Program ended successfully.\n";
+    if (memory)
+        munmap(memory, size);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string option = argc > 1 ? argv[1] : "";
+    if (option == "--raw-input" && argc == 3)
+        return runRaw(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (option == "--write-input" && argc == 4)
+        return writeInput(static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)), argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (argc > 1)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--raw-input <file> | --write-input <values> <file>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // In __REG_2
+    std::cout << "Enter a value: ";
+    unsigned int amount{0};
+    std::cin >> amount;
+
+    // List @__REG_2 __REG_3
+    std::vector<unsigned int> array(amount);
+
+    // ListInit __REG_3
+    for (std::size_t i = 0; i < array.size(); ++i)
+    {
+        std::cout << "Enter value for index " << i << ": ";
+        std::cin >> array[i];
+    }
+
+    // ListSum __REG_3 __REG_4
+    unsigned int sum{0};
+    for (unsigned int value : array)
+        sum += value;
+
+    // Out __REG_4
+    std::cout << sum << std::endl;
+
+    // Stop
+    std::cout << "Program ended successfully.\n";
+    return EXIT_SUCCESS;
+}
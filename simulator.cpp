@@ -7,14 +7,34 @@
  */
 
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <list>
 #include <cstdlib>
 #include <cmath>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <system_error>
+#include <iomanip>
+#include <new>
+#include <atomic>
+#include <climits>
+#include <limits>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 /** The global namespace for the project */
 namespace global
@@ -33,24 +53,249 @@ namespace global
      */
     std::string instruction;
 
-    std::string opcode;                                      // Stores the opcode of the instruction
-    std::map<std::string, unsigned int> registers;           // A map from strings to unsigned ints for registers
-    std::map<std::string, std::vector<unsigned int>> arrays; // A map from strings to vectors of unsigned ints for arrays
-    std::list<std::string> memory;                           // A list of strings used for memory
+    /**
+     * A handle to a List. Handles made by ListSlice and ListView share the
+     * storage of the List they were made from and only cover part of it, so
+     * they never copy elements. The storage lives until its last handle goes.
+     */
+    struct ListHandle
+    {
+        std::shared_ptr<std::vector<unsigned int>> storage; // The elements, possibly shared with other handles
+        std::size_t offset{0};                              // Index of the handle's first element in storage
+        std::size_t size{0};                                // Number of elements the handle covers
+
+        /** @return Pointer to the handle's first element */
+        unsigned int *data() const { return storage ? storage->data() + offset : nullptr; }
+    };
+
+    /*
+     * List registers name one of four handles in the current bank. ListBank
+     * selects the bank with its 6-bit address field, which gives 64 banks of
+     * four, so a program can keep up to 256 Lists alive at once.
+     */
+    const std::size_t listHandles = 64 * 4;
+
+    std::string opcode;                            // Stores the opcode of the instruction
+    std::map<std::string, unsigned int> registers; // A map from strings to unsigned ints for registers
+    std::vector<ListHandle> arrays(listHandles);   // The List handle table, indexed by bank * 4 + register
+    unsigned int listBank{0};                      // The bank List registers currently refer to
+    std::list<std::string> memory;                 // A list of strings used for memory
+
+    /*
+     * Histograms with at most histogramCopyLimit buckets are counted into
+     * histogramCopies private copies. Each copy is one contiguous block of
+     * buckets, stored one after another; only the elements are interleaved,
+     * element i going to copy i % histogramCopies. Whether that is faster
+     * than one copy depends on the host, so one copy is used unless
+     * --calibrate measured a gain and saved a profile for this CPU.
+     */
+    std::size_t histogramCopies = 1;
+    std::size_t histogramCopyLimit = 0;
+    std::vector<unsigned int> histogramCounts; // Scratch space for the copies, kept between ListHistogram runs
+
+    /*
+     * In real-time mode every input value is read before the program starts
+     * and every Out value is held until it ends, in buffers sized from the
+     * resource estimate, so execution itself never blocks on I/O or allocates.
+     * With --mlock the buffers are also locked into RAM once they are sized.
+     */
+    bool realTime{false};              // Whether the program runs in real-time mode
+    bool lockMemory{false};            // Whether real-time mode locks its buffers into RAM
+    std::vector<unsigned int> inputs;  // Input values read up front in real-time mode
+    std::size_t nextInput{0};          // Index of the next value to take from inputs
+    std::vector<unsigned int> outputs; // Out values held back in real-time mode
+    std::size_t stops{0};              // Stop instructions executed in real-time mode
+    std::size_t allocations{0};        // Number of calls to operator new, see below
+
+    /*
+     * With --results, every job's Out values are also written to a columnar
+     * binary file for analytics to mmap. Rows are written in chunks as jobs
+     * finish, so a stream that never ends still fills the file and never holds
+     * more than a chunk in memory. The layout, in host byte order
+     * (little-endian on every host we run on), is:
+     *
+     *   char magic[4] = "CLRS", u32 version = 2, u64 rows, u64 chunks,
+     *   then for each chunk:
+     *   u64 count, u32 job[count], u32 index[count], u32 value[count],
+     *   u32 status[count], u64 instructions[count]
+     *
+     * rows and chunks are rewritten after each chunk is complete, so a reader
+     * that trusts them never sees a half-written chunk. Every chunk starts on
+     * an 8-byte boundary.
+     *
+     * Each job ends with a row whose index is 0xFFFFFFFF and whose value is 0,
+     * so a job that wrote nothing still has its exit status and the number of
+     * instructions it executed recorded.
+     */
+    struct Results
+    {
+        std::vector<std::uint32_t> job;          // The job that wrote the value
+        std::vector<std::uint32_t> index;        // Position of the value among the job's Out values
+        std::vector<std::uint32_t> value;        // The value written by Out
+        std::vector<std::uint32_t> status;       // The job's exit status
+        std::vector<std::uint64_t> instructions; // Instructions the job executed
+    };
+
+    std::string resultsPath;                              // Where to write the results file; empty if not asked for
+    std::ofstream resultsFile;                            // The results file, open for the whole run
+    Results results;                                      // Rows not yet written to the results file
+    std::uint64_t resultsRows{0};                         // Rows written to the results file so far
+    std::uint64_t resultsChunks{0};                       // Chunks written to the results file so far
+    std::chrono::steady_clock::time_point resultsWritten; // When the last chunk was written
+
+    const std::size_t resultsChunkRows = 1 << 16;  // Rows held before a chunk is written
+    const std::chrono::seconds resultsChunkAge{1}; // Longest a finished job's rows wait to be written
+
+    const std::uint32_t ringCapacity = 4096; // Slots in the output ring, a power of two
+
+    /*
+     * With --shm-ring, Out values go into this single-producer single-consumer
+     * ring in POSIX shared memory instead of to the screen. head and tail count
+     * values ever written and read; slot i % ringCapacity holds value i. The
+     * consumer reads values while tail != head, then stores the new tail.
+     * closed becomes 1 after the last value.
+     *
+     * To sleep, the consumer loads sequence, then head and closed; if the ring
+     * is still empty and not closed it does FUTEX_WAIT on sequence with the
+     * value it loaded. The simulator bumps sequence and does a FUTEX_WAKE on it
+     * whenever head moves on from an empty ring, and when it closes the ring,
+     * so a wake that lands between the consumer's check and its wait changes
+     * sequence and the wait returns at once.
+     */
+    struct OutputRing
+    {
+        alignas(64) std::atomic<std::uint32_t> head;     // Written by the simulator only
+        alignas(64) std::atomic<std::uint32_t> tail;     // Written by the consumer only
+        alignas(64) std::atomic<std::uint32_t> closed;   // Written by the simulator only
+        alignas(64) std::atomic<std::uint32_t> sequence; // Bumped by the simulator to wake the consumer
+        std::uint32_t values[ringCapacity];
+    };
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free,
+                  "the ring's counters double as futex words");
+
+    OutputRing *ring{nullptr}; // The output ring, if one was asked for
+
+    /**
+     * @brief Calls the futex system call on one of the ring's counters.
+     *
+     * @param word The counter
+     * @param op FUTEX_WAIT or FUTEX_WAKE
+     * @param value The expected value for FUTEX_WAIT, or how many to wake
+     * @param timeout How long FUTEX_WAIT may sleep, or nullptr
+     */
+    void futex(std::atomic<std::uint32_t> &word, int op, std::uint32_t value, const timespec *timeout = nullptr)
+    {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), op, value, timeout, nullptr, 0);
+    }
+
+    /**
+     * The ring is created if it does not exist, and emptied either way.
+     *
+     * @brief Maps the output ring from shared memory.
+     *
+     * @param name The shared memory object's name, for example "/clobos"
+     * @return true if the ring was mapped, false otherwise
+     */
+    bool openRing(std::string name)
+    {
+        if (name.empty() || name[0] != '/')
+            name = "/" + name;
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, sizeof(OutputRing)) != 0)
+        {
+            std::cerr << "Error: Could not create shared memory \'" << name << "\'." << std::endl;
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+
+        void *memory = mmap(nullptr, sizeof(OutputRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED)
+        {
+            std::cerr << "Error: Could not map shared memory \'" << name << "\'." << std::endl;
+            return false;
+        }
+
+        ring = static_cast<OutputRing *>(memory);
+        ring->head = 0;
+        ring->tail = 0;
+        ring->closed = 0;
+        ring->sequence = 0;
+        return true;
+    }
+
+    /**
+     * Waits while the ring is full. The consumer is not required to wake the
+     * simulator, so each wait is capped at a millisecond before looking again.
+     *
+     * @brief Publishes a value to the output ring.
+     *
+     * @param value The value to publish
+     */
+    void ringPush(std::uint32_t value)
+    {
+        const std::uint32_t head = ring->head.load(std::memory_order_relaxed);
+        const timespec pause{0, 1000000};
+        for (std::uint32_t tail; head - (tail = ring->tail.load(std::memory_order_acquire)) == ringCapacity;)
+            futex(ring->tail, FUTEX_WAIT, tail, &pause);
+
+        ring->values[head % ringCapacity] = value;
+        ring->head.store(head + 1); // Sequentially consistent, so the tail load below cannot move above it
+        if (ring->tail.load() == head)
+        {
+            ring->sequence.fetch_add(1);
+            futex(ring->sequence, FUTEX_WAKE, INT_MAX);
+        }
+    }
+
+    /**
+     * @brief Marks the end of the output and wakes a waiting consumer.
+     */
+    void closeRing()
+    {
+        ring->closed.store(1);
+        ring->sequence.fetch_add(1);
+        futex(ring->sequence, FUTEX_WAKE, INT_MAX);
+    }
 
     enum Opcode : unsigned int
     {
         Stop = 0b00000, // Stop -- Terminate the program
-        In,             // In <dest.> -- Input value from the keyboard
+        In,             // In <dest.> -- Input value from the keyboard, or from the raw input file
         Out,            // Out <src.> -- Output value to the screen
         Incr,           // Incr <src.> <amt.> -- Increment the value at the address by an amount
         Add,            // Add <lhs> <rhs> <dest.> -- Add the value at two address and store result at last address
         Sub,            // Sub <lhs> <rhs> <dest.> -- Subtract the value at two address and store result at last address
         Mul,            // Mul <lhs> <rhs> <dest.> -- Multiply the value at two address and store result at last address
         List,           // List <amt.> <src.> -- Create an array and store at an address
-        ListInit,       // ListInit <src.> -- Initialize an array; reads the values from the keyboard
+        ListInit,       // ListInit <src.> -- Initialize an array; reads the values from the keyboard, or from the raw input file
         ListSum,        // ListSum <src.> <dest.> -- Sum the values in an array
         TidyUp,         // Clear all regsiters
+        ListFill,       // ListFill <src.> <value> -- Set every value in an array to the value in a register
+        ListIota,       // ListIota <src.> <start> <step> -- Fill an array with start, start + step, start + 2 * step, ...
+        ListRandom,     // ListRandom <src.> <seed> -- Fill an array with pseudo-random values derived from a seed
+        ListSlice,      // ListSlice <dest.> <src.> <start> <amt.> -- Make dest. refer to part of an array, without copying
+        ListView,       // ListView <dest.> <src.> -- Make dest. refer to the same values as an array, without copying
+        ListBank,       // ListBank <addr.> -- Select which bank of four Lists the List registers refer to
+        ListHistogram,  // ListHistogram <src.> <dest.> <width> -- Count the values of an array into buckets of a width
+    };
+
+    /**
+     * Resource needs of a program, worked out before it runs.
+     * When exact is false some List size depends on a value read at run time,
+     * and the List and input figures are lower bounds instead of exact counts.
+     */
+    struct Estimate
+    {
+        std::size_t instructions{0};                                                  // Instructions executed
+        std::size_t listWords{0};                                                     // Peak number of live List elements
+        std::vector<std::size_t> listCapacity{std::vector<std::size_t>(listHandles)}; // Largest size each List handle is given
+        std::size_t inputs{0};                                                        // Values read by In and ListInit
+        std::size_t outputs{0};                                                       // Values written by Out
+        std::size_t histogramScratch{0};                                              // Scratch elements the largest ListHistogram counts into
+        bool exact{true};                                                             // true if every figure above is exact
     };
 
     /**
@@ -76,200 +321,1527 @@ namespace global
         }
         return true;
     }
-}
-
-/**
- * Given a binary number as a string, returns the corresponding integer.
- * For example, given "0b00001", returns 1.
- *
- * @brief Converts a binary number to an integer.
- *
- * @param binary The binary number as a string
- * @return The integer corresponding to the binary number
- */
-unsigned int binaryToDecimal(const std::string &binary);
 
-int main()
-{
-    using namespace global;
+    /**
+     * The register is assumed to be valid, see validRegister().
+     *
+     * @brief Finds the List handle a List register refers to in the current bank.
+     *
+     * @param reg The List register
+     * @return The handle in the List handle table
+     */
+    ListHandle &listHandle(const std::string &reg)
+    {
+        return arrays[listBank * 4 + (reg[0] == '1') * 2 + (reg[1] == '1')];
+    }
 
-    std::ifstream inputFile("benchmarkBinary.txt");
-    if (inputFile.fail())
+    /**
+     * Sums a contiguous run of List elements. The loop has no early exits and
+     * wraps on overflow like the registers do, so the compiler is free to
+     * reorder the additions and emit SIMD code for it.
+     *
+     * @brief Sums the values of a List.
+     *
+     * @param data Pointer to the first element
+     * @param size The number of elements to sum
+     * @return The sum of the elements, modulo 2^32
+     */
+    unsigned int listSum(const unsigned int *data, std::size_t size)
     {
-        std::cerr << "Error: Could not open file." << std::endl;
-        return EXIT_FAILURE;
+        unsigned int sum{0};
+        for (std::size_t i = 0; i < size; ++i)
+            sum += data[i];
+        return sum;
     }
 
-    // Initialize registers
-    registers["00"] = 0; // __REG_0
-    registers["01"] = 0; // __REG_1
-    registers["10"] = 0; // __REG_2
-    registers["11"] = 0; // __REG_3
+    const std::size_t parallelThreshold = 1 << 20; // Elements per thread below which a List kernel stays on one thread
+    const std::size_t kernelUnroll = 8;            // Elements a generator kernel writes per loop step
 
-    // Read the file
-    while (inputFile >> instruction)
-        memory.push_back(instruction);
+    /**
+     * Lists of at least two parallelThreshold elements are split into
+     * contiguous chunks, one per hardware thread, with every chunk but the
+     * last a whole number of cache lines long. Real-time mode always stays on
+     * one thread, since starting a thread allocates.
+     *
+     * @brief Runs a List kernel over a range of elements, on several threads
+     *        when the range is large enough.
+     *
+     * @param size The number of elements
+     * @param body Called as body(begin, end) for each chunk of elements
+     */
+    template <typename Body>
+    void parallelChunks(std::size_t size, Body body)
+    {
+        std::size_t threads = realTime ? 1 : std::min<std::size_t>(std::thread::hardware_concurrency(), size / parallelThreshold);
+        if (threads <= 1)
+        {
+            body(std::size_t{0}, size);
+            return;
+        }
 
-    inputFile.close(); // Close the file
+        const std::size_t line = 64 / sizeof(unsigned int);
+        const std::size_t chunk = (size / threads + line - 1) / line * line;
+        std::vector<std::thread> workers;
+        std::size_t begin = chunk;
+        for (; begin < size; begin += chunk)
+        {
+            try
+            {
+                workers.emplace_back(body, begin, std::min(begin + chunk, size));
+            }
+            catch (const std::system_error &) // Out of threads; do the rest here
+            {
+                break;
+            }
+        }
+        body(std::size_t{0}, chunk);
+        if (begin < size)
+            body(begin, size);
+        for (auto &worker : workers)
+            worker.join();
+    }
 
-    // Preprocess the memory
-    // Check if Stop instruction is present
-    if (std::find(memory.begin(), memory.end(), "0000000000000") == memory.end())
+    /**
+     * Elements are written kernelUnroll at a time, which GCC vectorizes at
+     * -O2 as well as -O3.
+     *
+     * @brief Sets every element of a List to the same value.
+     *
+     * @param data Pointer to the first element
+     * @param size The number of elements to set
+     * @param value The value to store
+     */
+    void listFill(unsigned int *data, std::size_t size, unsigned int value)
     {
-        std::cerr << "Error: Could not find the \'Stop\' instruction." << std::endl;
-        return EXIT_FAILURE;
+        parallelChunks(size, [=](std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for (; i + kernelUnroll <= end; i += kernelUnroll)
+                for (std::size_t j = 0; j < kernelUnroll; ++j)
+                    data[i + j] = value;
+            for (; i < end; ++i)
+                data[i] = value;
+        });
     }
 
-    // Iterate through the memory
-    for (std::string &ins : memory)
+    /**
+     * Each element is computed from its own index rather than from the element
+     * before it, so the loop carries no dependency, chunks can be filled on
+     * separate threads, and the kernelUnroll elements of each step vectorize
+     * at -O2.
+     *
+     * @brief Fills a List with an arithmetic sequence.
+     *
+     * @param data Pointer to the first element
+     * @param size The number of elements to set
+     * @param start The value of the first element
+     * @param step The difference between neighbouring elements
+     */
+    void listIota(unsigned int *data, std::size_t size, unsigned int start, unsigned int step)
     {
-        // Check if opcodes are valid
-        if (binaryToDecimal(ins.substr(0, 5)) > Opcode::TidyUp)
+        parallelChunks(size, [=](std::size_t begin, std::size_t end)
         {
-            std::cerr << "Error: Invalid opcode \'" << ins.substr(0, 5) << "\'\n";
-            return EXIT_FAILURE;
-        }
+            std::size_t i = begin;
+            for (; i + kernelUnroll <= end; i += kernelUnroll)
+                for (std::size_t j = 0; j < kernelUnroll; ++j)
+                    data[i + j] = start + static_cast<unsigned int>(i + j) * step;
+            for (; i < end; ++i)
+                data[i] = start + static_cast<unsigned int>(i) * step;
+        });
     }
 
-    // Begin execution
-    for (auto it = memory.begin(); it != memory.end(); ++it)
+    /**
+     * Element i is the upper half of the i-th output of SplitMix64 seeded with
+     * seed. The generator is counter-based, so chunks of the List are filled
+     * on separate threads. It does not vectorize on SSE2, which has no 64-bit
+     * multiply, so each thread runs it scalar.
+     *
+     * @brief Fills a List with deterministic pseudo-random values.
+     *
+     * @param data Pointer to the first element
+     * @param size The number of elements to set
+     * @param seed The seed the values are derived from
+     */
+    void listRandom(unsigned int *data, std::size_t size, unsigned int seed)
     {
-        instruction = *it;
-        opcode = instruction.substr(0, 5);
-
-        if (binaryToDecimal(opcode) == Opcode::Stop)
-        {
-            std::cout << "Program ended successfully.\n";
-        }
-        else if (binaryToDecimal(opcode) == 1)
+        parallelChunks(size, [=](std::size_t begin, std::size_t end)
         {
-            std::cout << "Enter a value: ";
-            unsigned int value{0};
-            std::cin >> value;
-
-            std::string destination = instruction.substr(5, 2);
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ull;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                data[i] = static_cast<unsigned int>((z ^ (z >> 31)) >> 32);
+            }
+        });
+    }
 
-            if (!validRegister(destination))
-                return EXIT_FAILURE;
+    /**
+     * Value v is counted in bucket v / width; values past the last bucket are
+     * counted in the last one. Small histograms may be counted into several
+     * private copies, element i going to copy i % copies, and merged at the end.
+     *
+     * @brief Counts the values of a List into buckets.
+     *
+     * @param data Pointer to the first element to count
+     * @param size The number of elements to count
+     * @param buckets Pointer to the first bucket; may overlap data
+     * @param count The number of buckets
+     * @param width The range of values each bucket covers; 0 is taken as 1
+     */
+    void listHistogram(const unsigned int *data, std::size_t size, unsigned int *buckets, std::size_t count, unsigned int width)
+    {
+        if (count == 0)
+            return;
+        width = std::max(width, 1u);
 
-            registers[destination] = value;
-        }
-        else if (binaryToDecimal(opcode) == Opcode::Out)
-        {
-            auto source = instruction.substr(5, 2);
+        const std::size_t copies = count <= histogramCopyLimit ? std::max<std::size_t>(histogramCopies, 1) : 1;
+        auto &counts = histogramCounts;
+        counts.assign(copies * count, 0);
+        auto bucket = [&](unsigned int value) { return std::min<std::size_t>(value / width, count - 1); };
 
-            if (!validRegister(source))
-                return EXIT_FAILURE;
+        std::size_t i = 0;
+        if (copies > 1)
+            for (; i + copies <= size; i += copies)
+                for (std::size_t lane = 0; lane < copies; ++lane)
+                    ++counts[lane * count + bucket(data[i + lane])];
+        for (; i < size; ++i)
+            ++counts[bucket(data[i])];
 
-            std::cout << registers[source] << std::endl;
-        }
-        else if (binaryToDecimal(opcode) == Opcode::Incr)
+        for (std::size_t b = 0; b < count; ++b)
         {
-            auto amount = binaryToDecimal(instruction.substr(5, 6));
-            auto source = instruction.substr(11);
-
-            if (!validRegister(source))
-                return EXIT_FAILURE;
-
-            registers[source] += amount;
+            unsigned int total{0};
+            for (std::size_t copy = 0; copy < copies; ++copy)
+                total += counts[copy * count + b];
+            buckets[b] = total;
         }
-        else if (binaryToDecimal(opcode) == Opcode::Add)
-        {
-            std::string lhs, rhs, destination;
-            lhs = instruction.substr(5, 2);
-            rhs = instruction.substr(7, 2);
-            destination = instruction.substr(9, 2);
+    }
 
-            if (!validRegister(destination))
-                return EXIT_FAILURE;
+    /*
+     * With --raw-input, In and ListInit take raw little-endian u32 values from
+     * a file instead of parsing text from the keyboard. Regular files are
+     * memory-mapped; pipes and other files that cannot be mapped are read as
+     * values are needed. Reading past the end of the input gives 0, like a
+     * failed keyboard read does.
+     */
+    bool rawInput{false};                     // Whether input comes from the raw input file
+    const unsigned char *rawData{nullptr};    // The mapped raw input file
+    std::size_t rawSize{0};                   // Size of the raw input file in bytes
+    std::size_t rawOffset{0};                 // Bytes of the raw input file consumed so far
+    int rawDescriptor{-1};                    // The raw input when it is not a regular file
+    std::string rawPath;                      // The raw input file, for messages
 
-            registers[destination] = registers[lhs] + registers[rhs];
-        }
-        else if (binaryToDecimal(opcode) == Opcode::Sub)
+    /**
+     * @brief Opens a raw input file for In and ListInit to read from.
+     *
+     * @param path The file to open
+     * @return true if the file was opened, false otherwise
+     */
+    bool openRawInput(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0)
         {
-            std::string lhs, rhs, destination;
-            lhs = instruction.substr(5, 2);
-            rhs = instruction.substr(7, 2);
-            destination = instruction.substr(9, 2);
-
-            if (!validRegister(destination))
-                return EXIT_FAILURE;
-
-            registers[destination] = registers[lhs] - registers[rhs];
+            std::cerr << "Error: Could not open raw input file \'" << path << "\'." << std::endl;
+            if (fd >= 0)
+                close(fd);
+            return false;
         }
-        else if (binaryToDecimal(opcode) == Opcode::Mul)
-        {
-            std::string lhs, rhs, destination;
-            lhs = instruction.substr(5, 2);
-            rhs = instruction.substr(7, 2);
-            destination = instruction.substr(9, 2);
-
-            if (!validRegister(destination))
-                return EXIT_FAILURE;
 
-            registers[destination] = registers[lhs] * registers[rhs];
+        rawInput = true;
+        rawPath = path;
+        if (!S_ISREG(info.st_mode))
+        {
+            rawDescriptor = fd;
+            return true;
         }
-        else if (binaryToDecimal(opcode) == Opcode::List)
+
+        rawSize = static_cast<std::size_t>(info.st_size);
+        if (rawSize % sizeof(std::uint32_t) != 0)
+            std::cerr << "Warning: Raw input file \'" << path << "\' ends with a partial value, which is ignored." << std::endl;
+        if (rawSize > 0)
         {
-            std::size_t amount;
-            if (instruction.substr(7, 4) == "0000") // Size is in a register
+            void *memory = mmap(nullptr, rawSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory == MAP_FAILED)
             {
-                auto registerAddress = instruction.substr(5, 2);
-
-                if (!validRegister(registerAddress))
-                    return EXIT_FAILURE;
-
-                amount = registers[registerAddress];
+                std::cerr << "Error: Could not map raw input file \'" << path << "\'." << std::endl;
+                close(fd);
+                return false;
             }
-            else // Size is a literal
-                amount = static_cast<std::size_t>(binaryToDecimal(instruction.substr(5, 6)));
-            auto source = instruction.substr(11);
-
-            if (!validRegister(source))
-                return EXIT_FAILURE;
-
-            arrays[source] = std::vector<unsigned int>(amount);
+            madvise(memory, rawSize, MADV_SEQUENTIAL);
+            rawData = static_cast<const unsigned char *>(memory);
         }
-        else if (binaryToDecimal(opcode) == Opcode::ListInit)
-        {
-            auto source = instruction.substr(5, 2);
-
-            if (!validRegister(source))
-                return EXIT_FAILURE;
+        close(fd);
+        return true;
+    }
 
-            for (std::size_t i = 0; i < arrays[source].size(); ++i)
+    /**
+     * Values are copied straight out of the mapping, or read straight into
+     * data from a pipe, with no parsing. Values past the end of the file are
+     * set to 0.
+     *
+     * @brief Reads input values from the raw input file.
+     *
+     * @param data Where to store the values
+     * @param count The number of values to read
+     */
+    void readRaw(unsigned int *data, std::size_t count)
+    {
+        if (rawDescriptor >= 0)
+        {
+            // A pipe can return fewer bytes than asked for, so read until the values are complete or it ends
+            auto *bytes = reinterpret_cast<unsigned char *>(data);
+            std::size_t wanted = count * sizeof(std::uint32_t), got{0};
+            while (got < wanted)
             {
-                std::cout << "Enter value for index " << i << ": ";
-                std::cin >> arrays[source][i];
+                ssize_t n = read(rawDescriptor, bytes + got, wanted - got);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    if (n < 0)
+                        std::cerr << "Error: Could not read raw input file \'" << rawPath << "\'." << std::endl;
+                    close(rawDescriptor);
+                    rawDescriptor = -1;
+                    break;
+                }
+                got += static_cast<std::size_t>(n);
             }
+            if (got % sizeof(std::uint32_t) != 0)
+                std::cerr << "Warning: Raw input file \'" << rawPath << "\' ends with a partial value, which is ignored." << std::endl;
+            std::fill(data + got / sizeof(std::uint32_t), data + count, 0u);
+            return;
         }
-        else if (binaryToDecimal(opcode) == Opcode::ListSum)
-        {
-            auto source = instruction.substr(5, 2);
-            auto destination = instruction.substr(7, 2);
-            unsigned int sum{0};
 
-            if (!(validRegister(source) && validRegister(destination)))
-                return EXIT_FAILURE;
+        std::size_t available = std::min(count, (rawSize - rawOffset) / sizeof(std::uint32_t));
+        if (available > 0)
+            std::memcpy(data, rawData + rawOffset, available * sizeof(std::uint32_t));
+        std::fill(data + available, data + count, 0u);
+        rawOffset += available * sizeof(std::uint32_t);
+    }
 
-            for (unsigned int value : arrays[source])
-                sum += value;
-            registers[destination] = sum;
-        }
-        else if (binaryToDecimal(opcode) == Opcode::TidyUp)
-        {
-            for (auto &reg : registers)
-                reg.second = 0;
-        }
+    /**
+     * @brief Reads the next value from wherever input comes from.
+     *
+     * @return The next value in the raw input file, or typed at the keyboard
+     */
+    unsigned int readSource()
+    {
+        unsigned int value{0};
+        if (rawInput)
+            readRaw(&value, 1);
+        else
+            std::cin >> value;
+        return value;
+    }
+
+    /**
+     * @brief Reads the next input value for In or ListInit.
+     *
+     * @return The next value from readSource(), or in real-time mode the next
+     *         value read up front
+     */
+    unsigned int readValue()
+    {
+        if (realTime)
+            return nextInput < inputs.size() ? inputs[nextInput++] : 0;
+        return readSource();
+    }
+
+    /**
+     * Values go to the output ring if there is one, and are otherwise printed,
+     * or held back in real-time mode. They are also kept in outputs when a
+     * results file is being written.
+     *
+     * @brief Writes a value for Out.
+     *
+     * @param value The value to write
+     */
+    void writeValue(unsigned int value)
+    {
+        if (realTime || !resultsPath.empty())
+            outputs.push_back(value);
+        if (ring)
+            ringPush(value);
+        else if (!realTime)
+            std::cout << value << std::endl;
     }
-    return EXIT_SUCCESS;
 }
 
-unsigned int binaryToDecimal(const std::string &binary)
+/*
+ * Every allocation is counted so that real-time mode can report one made
+ * while the program runs as an error instead of letting it add jitter.
+ */
+void *operator new(std::size_t size)
 {
-    unsigned int result{0};
-    for (std::size_t i = 0; i < binary.length(); ++i)
-        if (binary[i] == '1')
-            result += pow(2, binary.length() - 1 - i);
-    return result;
-}
\ No newline at end of file
+    ++global::allocations;
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+/**
+ * Runs a kernel over and over until enough time has passed to trust the
+ * clock. Runs go in batches that double in size between clock reads, so
+ * reading the clock costs next to nothing even for kernels on tiny Lists.
+ *
+ * @brief Times a kernel.
+ *
+ * @param kernel The kernel to run, callable with no arguments
+ * @return The seconds one run of the kernel takes
+ */
+template <typename Kernel>
+double timeKernel(Kernel kernel)
+{
+    std::size_t runs{0};
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{0};
+    for (std::size_t batch = 1; elapsed.count() < 0.05; batch *= 2)
+    {
+        for (std::size_t i = 0; i < batch; ++i)
+            kernel();
+        runs += batch;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return elapsed.count() / runs;
+}
+
+/**
+ * Given a binary number as a string, returns the corresponding integer.
+ * For example, given "0b00001", returns 1.
+ *
+ * @brief Converts a binary number to an integer.
+ *
+ * @param binary The binary number as a string
+ * @return The integer corresponding to the binary number
+ */
+unsigned int binaryToDecimal(const std::string &binary);
+
+/**
+ * Decodes and executes one instruction against the global machine state.
+ * Execution only ever stops between two calls, so a caller can pause the
+ * machine at any instruction boundary and resume it later.
+ *
+ * @brief Executes a single instruction.
+ *
+ * @param ins The instruction to execute
+ * @return true if the instruction executed, false on an error
+ */
+bool execute(const std::string &ins);
+
+/**
+ * Walks a straight-line program once, tracking which register values are
+ * known constants, to work out the instructions, List memory and I/O values
+ * it will need. List sizes are exact when they are literals or are computed
+ * from constants; a size that comes from In or ListSum makes the estimate a
+ * lower bound. If input is given, the values In and ListInit will consume are
+ * read into it as the walk reaches them, and In values
+ * count as known.
+ *
+ * @brief Statically estimates the resources a program needs.
+ *
+ * @param program The program, one instruction per element
+ * @param input Where to store input values read up front, or nullptr
+ * @return The estimate for the program
+ */
+global::Estimate estimateResources(const std::list<std::string> &program, std::vector<unsigned int> *input = nullptr);
+
+/**
+ * The rows are written out with the others held so far once there are
+ * enough of them, or once the oldest has waited long enough.
+ *
+ * @brief Adds the Out values held in outputs to the results as one job's rows.
+ *
+ * @param job The job's id
+ * @param status The job's exit status
+ * @param executed The number of instructions the job executed
+ */
+void recordResults(std::uint32_t job, std::uint32_t status, std::uint64_t executed);
+
+/**
+ * @brief Creates the results file and writes its header, with no rows yet.
+ *
+ * @param path The file to create
+ * @return true if the file was created, false otherwise
+ */
+bool openResults(const std::string &path);
+
+/**
+ * Each column goes out in a single write, so a chunk is written with a
+ * handful of large sequential writes however many rows it has.
+ *
+ * @brief Writes the rows held so far to the results file as one chunk.
+ *
+ * @return true if the chunk was written, false otherwise
+ */
+bool writeResults();
+
+/**
+ * Reads instructions into memory, checking each opcode as it arrives. From a
+ * stream of programs, reading stops after the first Stop instruction, and
+ * the values the program's In and ListInit take follow it in the stream.
+ * Otherwise the whole source is read and must contain a Stop somewhere.
+ *
+ * @brief Loads a program into memory.
+ *
+ * @param source Where to read the program from
+ * @param stream true if source holds a stream of programs
+ * @return true if a program was loaded; false on an error, or if the
+ *         stream ended before another program started
+ */
+bool loadProgram(std::istream &source, bool stream);
+
+/**
+ * The machine is reset first, so every program in a stream starts from the
+ * same state, but List storage left over from the last program is kept and
+ * reused.
+ *
+ * @brief Runs the program in memory as one job.
+ *
+ * @param job The job's id in the results file
+ * @return EXIT_SUCCESS if the program ran, EXIT_FAILURE otherwise
+ */
+int runProgram(std::uint32_t job);
+
+/**
+ * Times every List kernel on Lists from 4 KiB, which fits in L1, up to
+ * 256 MiB, which only fits in DRAM, and prints the achieved bandwidth and
+ * element rate against the roofline bound. The bandwidth roof is measured
+ * with memcpy at each List size, so cache-resident sizes are held to cache
+ * bandwidth, and the compute roof with independent shift-adds on SSE
+ * vectors held in registers. An operation is one integer add, shift, xor,
+ * multiply, divide or compare, for the roof and the kernels alike; loads and
+ * stores are counted as bytes. Stores count twice, since the line is read
+ * before it is written. Both roofs are for one thread, so generator kernels
+ * that split large Lists across threads can pass 100%.
+ *
+ * @brief Runs the roofline benchmark for the List kernels.
+ */
+void roofline();
+
+/**
+ * @brief Finds the host's CPU model.
+ *
+ * @return The model name from /proc/cpuinfo, or "unknown"
+ */
+std::string cpuModel();
+
+/**
+ * Profiles are kept one per line, as the CPU model, the histogram copy count
+ * and the histogram copy limit separated by tabs, so hosts of different
+ * types can share one file.
+ *
+ * @brief Finds the file tuning profiles are kept in.
+ *
+ * @return $HOME/.clobos-tuning, or .clobos-tuning if HOME is not set
+ */
+std::string tuningPath();
+
+/**
+ * Reading the profile is the only startup cost; without a tuning file the
+ * built-in defaults are used and /proc/cpuinfo is not even read.
+ *
+ * @brief Loads the tuning profile for the host's CPU model, if there is one.
+ */
+void loadTuning();
+
+/**
+ * Times ListHistogram with 1, 2, 4 and 8 private copies, on uniform and on
+ * skewed data, for 16 to 16384 buckets. The copy count that does best
+ * relative to a single copy is kept, with the limit set to the largest
+ * bucket count below which it always wins. If no count beats a single copy,
+ * one copy with a limit of 0 is saved.
+ *
+ * @brief Calibrates the List kernels for this host and saves its profile.
+ *
+ * @return true if the profile was saved, false otherwise
+ */
+bool calibrate();
+
+int main(int argc, char *argv[])
+{
+    using namespace global;
+
+    // Read the options
+    bool stream{false};
+    bool benchmark{false};
+    bool report{false};
+    std::string ringName;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--realtime")
+            realTime = true;
+        else if (option == "--mlock")
+            lockMemory = true;
+        else if (option == "--stream")
+            stream = true;
+        else if (option == "--roofline")
+            benchmark = true;
+        else if (option == "--estimate")
+            report = true;
+        else if (option == "--calibrate")
+            return calibrate() ? EXIT_SUCCESS : EXIT_FAILURE;
+        else if (option == "--results")
+        {
+            if (i + 1 == argc)
+            {
+                std::cerr << "Error: Option \'" << option << "\' needs a file name." << std::endl;
+                return EXIT_FAILURE;
+            }
+            resultsPath = argv[++i];
+        }
+        else if (option == "--raw-input")
+        {
+            if (i + 1 == argc)
+            {
+                std::cerr << "Error: Option \'" << option << "\' needs a file name." << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!openRawInput(argv[++i]))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--shm-ring")
+        {
+            if (i + 1 == argc)
+            {
+                std::cerr << "Error: Option \'" << option << "\' needs a name." << std::endl;
+                return EXIT_FAILURE;
+            }
+            ringName = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option \'" << option << "\'." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (lockMemory && !realTime)
+    {
+        std::cerr << "Error: Option \'--mlock\' needs \'--realtime\'." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (report && stream)
+    {
+        std::cerr << "Error: Option \'--estimate\' cannot be used with \'--stream\'." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    loadTuning();
+
+    if (benchmark)
+    {
+        roofline();
+        return EXIT_SUCCESS;
+    }
+
+    // Initialize registers
+    registers["00"] = 0; // __REG_0
+    registers["01"] = 0; // __REG_1
+    registers["10"] = 0; // __REG_2
+    registers["11"] = 0; // __REG_3
+
+    if (!resultsPath.empty() && !openResults(resultsPath))
+        return EXIT_FAILURE;
+
+    // Open the ring last; from here on every exit goes through closeRing so the consumer is not left waiting
+    if (!ringName.empty() && !openRing(ringName))
+        return EXIT_FAILURE;
+
+    int status = EXIT_SUCCESS;
+    if (stream)
+    {
+        // Run programs from standard input as they arrive, until the stream ends
+        for (std::uint32_t job = 0; status == EXIT_SUCCESS; ++job)
+        {
+            if (!loadProgram(std::cin, true))
+            {
+                if (!(memory.empty() && std::cin.eof()))
+                {
+                    status = EXIT_FAILURE;
+                    if (!resultsPath.empty())
+                        recordResults(job, status, 0);
+                }
+                break;
+            }
+            status = runProgram(job);
+        }
+    }
+    else
+    {
+        std::ifstream inputFile("benchmarkBinary.txt");
+        if (inputFile.fail())
+        {
+            std::cerr << "Error: Could not open file." << std::endl;
+            status = EXIT_FAILURE;
+        }
+        else if (!loadProgram(inputFile, false))
+            status = EXIT_FAILURE;
+
+        if (status != EXIT_SUCCESS)
+        {
+            // A program that never ran still gets its row
+            if (!resultsPath.empty())
+                recordResults(0, status, 0);
+        }
+        else if (report)
+        {
+            // Report what the program needs instead of running it, for admission control
+            Estimate estimate = estimateResources(memory);
+            std::cout << "Instructions: " << estimate.instructions << "\n"
+                      << "List memory: " << estimate.listWords * sizeof(unsigned int) << " bytes at peak\n"
+                      << "Input values: " << estimate.inputs << "\n"
+                      << "Output values: " << estimate.outputs << "\n"
+                      << "Exact: " << (estimate.exact ? "yes" : "no, List memory and input values are lower bounds") << "\n";
+        }
+        else
+            status = runProgram(0);
+    }
+
+    if (ring)
+        closeRing();
+
+    if (!resultsPath.empty() && !writeResults())
+        return EXIT_FAILURE;
+    return status;
+}
+
+unsigned int binaryToDecimal(const std::string &binary)
+{
+    unsigned int result{0};
+    for (std::size_t i = 0; i < binary.length(); ++i)
+        if (binary[i] == '1')
+            result += pow(2, binary.length() - 1 - i);
+    return result;
+}
+
+global::Estimate estimateResources(const std::list<std::string> &program, std::vector<unsigned int> *input)
+{
+    using namespace global;
+
+    Estimate estimate;
+    unsigned int value[4]{0};                   // Register contents, where known
+    bool known[4]{true, true, true, true};      // Whether value[i] is known
+    unsigned int bank{0};                       // The List bank in effect
+    std::vector<std::size_t> size(listHandles); // List handle sizes, where known
+    std::vector<bool> sized(listHandles, true); // Whether size[i] is known
+    std::vector<int> owner(listHandles, -1);    // Index into storage each handle refers to
+    std::vector<std::size_t> storage;           // Sizes of the storage each List instruction allocates
+    std::vector<std::size_t> users;             // Number of handles referring to each storage
+    std::size_t live{0};                        // Elements of storage some handle still refers to
+
+    // Reads the next input value up front, if asked to
+    auto read = [&]()
+    {
+        input->push_back(readSource());
+        return input->back();
+    };
+
+    // Points a handle at a storage, releasing the one it referred to before
+    auto refer = [&](std::size_t handle, int id)
+    {
+        if (id >= 0 && users[id]++ == 0)
+            live += storage[id];
+        if (owner[handle] >= 0 && --users[owner[handle]] == 0)
+            live -= storage[owner[handle]];
+        owner[handle] = id;
+    };
+
+    for (const std::string &ins : program)
+    {
+        ++estimate.instructions;
+        if (ins.size() != 13) // Rejected or misread at run time; nothing to learn
+        {
+            estimate.exact = false;
+            continue;
+        }
+
+        auto op = binaryToDecimal(ins.substr(0, 5));
+        auto a = binaryToDecimal(ins.substr(5, 2));
+        auto b = binaryToDecimal(ins.substr(7, 2));
+        auto c = binaryToDecimal(ins.substr(9, 2));
+        auto last = binaryToDecimal(ins.substr(11));
+
+        if (op == Opcode::In)
+        {
+            ++estimate.inputs;
+            known[a] = input != nullptr;
+            if (input)
+                value[a] = read();
+        }
+        else if (op == Opcode::Out)
+            ++estimate.outputs;
+        else if (op == Opcode::Incr)
+            value[last] += binaryToDecimal(ins.substr(5, 6));
+        else if (op == Opcode::Add || op == Opcode::Sub || op == Opcode::Mul)
+        {
+            known[c] = known[a] && known[b];
+            if (op == Opcode::Add)
+                value[c] = value[a] + value[b];
+            else if (op == Opcode::Sub)
+                value[c] = value[a] - value[b];
+            else
+                value[c] = value[a] * value[b];
+        }
+        else if (op == Opcode::List)
+        {
+            auto list = bank * 4 + last;
+            if (ins.substr(7, 4) == "0000") // Size is in a register
+            {
+                sized[list] = known[a];
+                size[list] = known[a] ? value[a] : 0;
+            }
+            else // Size is a literal
+            {
+                sized[list] = true;
+                size[list] = binaryToDecimal(ins.substr(5, 6));
+            }
+
+            storage.push_back(size[list]);
+            users.push_back(0);
+            refer(list, static_cast<int>(storage.size()) - 1);
+            estimate.exact = estimate.exact && sized[list];
+            estimate.listCapacity[list] = std::max(estimate.listCapacity[list], size[list]);
+            estimate.listWords = std::max(estimate.listWords, live);
+        }
+        else if (op == Opcode::ListInit)
+        {
+            estimate.inputs += size[bank * 4 + a];
+            estimate.exact = estimate.exact && sized[bank * 4 + a];
+            for (std::size_t i = 0; input && i < size[bank * 4 + a]; ++i)
+                read();
+        }
+        else if (op == Opcode::ListSum)
+            known[b] = false;
+        else if (op == Opcode::TidyUp)
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                value[i] = 0;
+                known[i] = true;
+            }
+        else if (op == Opcode::ListSlice)
+        {
+            refer(bank * 4 + a, owner[bank * 4 + b]);
+            sized[bank * 4 + a] = known[last];
+            size[bank * 4 + a] = known[last] ? value[last] : 0;
+        }
+        else if (op == Opcode::ListView)
+        {
+            refer(bank * 4 + a, owner[bank * 4 + b]);
+            sized[bank * 4 + a] = sized[bank * 4 + b];
+            size[bank * 4 + a] = size[bank * 4 + b];
+        }
+        else if (op == Opcode::ListBank)
+            bank = binaryToDecimal(ins.substr(5, 6));
+        else if (op == Opcode::ListHistogram)
+        {
+            // One set of buckets per private copy, as listHistogram lays them out
+            std::size_t count = size[bank * 4 + b];
+            std::size_t copies = count <= histogramCopyLimit ? std::max<std::size_t>(histogramCopies, 1) : 1;
+            estimate.exact = estimate.exact && sized[bank * 4 + b];
+            estimate.histogramScratch = std::max(estimate.histogramScratch, copies * count);
+        }
+    }
+    return estimate;
+}
+
+void recordResults(std::uint32_t job, std::uint32_t status, std::uint64_t executed)
+{
+    using namespace global;
+
+    // Every job ends with a row that holds no value
+    outputs.push_back(0);
+    for (std::size_t i = 0; i < outputs.size(); ++i)
+    {
+        results.job.push_back(job);
+        results.index.push_back(i + 1 < outputs.size() ? static_cast<std::uint32_t>(i) : 0xFFFFFFFF);
+        results.value.push_back(outputs[i]);
+        results.status.push_back(status);
+        results.instructions.push_back(executed);
+    }
+    outputs.clear();
+
+    if (results.job.size() >= resultsChunkRows || std::chrono::steady_clock::now() - resultsWritten >= resultsChunkAge)
+        writeResults();
+}
+
+bool openResults(const std::string &path)
+{
+    using namespace global;
+
+    resultsFile.open(path, std::ios::binary | std::ios::trunc);
+    if (resultsFile.fail())
+    {
+        std::cerr << "Error: Could not open results file \'" << path << "\'." << std::endl;
+        return false;
+    }
+    resultsWritten = std::chrono::steady_clock::now();
+
+    const std::uint32_t version{2};
+    resultsFile.write("CLRS", 4);
+    resultsFile.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    resultsFile.write(reinterpret_cast<const char *>(&resultsRows), sizeof(resultsRows));
+    resultsFile.write(reinterpret_cast<const char *>(&resultsChunks), sizeof(resultsChunks));
+    resultsFile.flush();
+    if (resultsFile.fail())
+    {
+        std::cerr << "Error: Could not write results file \'" << resultsPath << "\'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writeResults()
+{
+    using namespace global;
+
+    resultsWritten = std::chrono::steady_clock::now();
+    const std::uint64_t rows = results.job.size();
+    if (rows == 0)
+        return !resultsFile.fail();
+
+    resultsFile.write(reinterpret_cast<const char *>(&rows), sizeof(rows));
+    for (const auto *column : {&results.job, &results.index, &results.value, &results.status})
+        resultsFile.write(reinterpret_cast<const char *>(column->data()), rows * sizeof(std::uint32_t));
+    resultsFile.write(reinterpret_cast<const char *>(results.instructions.data()), rows * sizeof(std::uint64_t));
+
+    // The chunk is complete, so the header can count it
+    resultsFile.flush();
+    resultsRows += rows;
+    ++resultsChunks;
+    resultsFile.seekp(8);
+    resultsFile.write(reinterpret_cast<const char *>(&resultsRows), sizeof(resultsRows));
+    resultsFile.write(reinterpret_cast<const char *>(&resultsChunks), sizeof(resultsChunks));
+    resultsFile.seekp(0, std::ios::end);
+    resultsFile.flush();
+
+    for (auto *column : {&results.job, &results.index, &results.value, &results.status})
+        column->clear();
+    results.instructions.clear();
+
+    if (resultsFile.fail())
+    {
+        std::cerr << "Error: Could not write results file \'" << resultsPath << "\'." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadProgram(std::istream &source, bool stream)
+{
+    using namespace global;
+
+    memory.clear();
+
+    // Read the program, checking each opcode and looking for Stop as it arrives
+    bool foundStop{false};
+    while ((!stream || !foundStop) && source >> instruction)
+    {
+        // Check if opcodes are valid
+        if (binaryToDecimal(instruction.substr(0, 5)) > Opcode::ListHistogram)
+        {
+            std::cerr << "Error: Invalid opcode \'" << instruction.substr(0, 5) << "\'\n";
+            return false;
+        }
+
+        foundStop = foundStop || instruction == "0000000000000";
+        memory.push_back(instruction);
+    }
+
+    // Check if Stop instruction is present
+    if (!foundStop)
+    {
+        if (!(stream && memory.empty()))
+            std::cerr << "Error: Could not find the \'Stop\' instruction." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int runProgram(std::uint32_t job)
+{
+    using namespace global;
+
+    // Reset the machine, keeping List storage that no two handles share
+    for (auto &reg : registers)
+        reg.second = 0;
+    for (auto &list : arrays)
+    {
+        if (list.storage.use_count() > 1)
+            list.storage.reset();
+        list.offset = 0;
+        list.size = 0;
+    }
+    listBank = 0;
+    inputs.clear();
+    nextInput = 0;
+    outputs.clear();
+    stops = 0;
+
+    // Preallocate List storage so List never has to grow a vector.
+    // Real-time mode reads all input here, so sizes taken from In are known.
+    try
+    {
+        Estimate estimate = estimateResources(memory, realTime ? &inputs : nullptr);
+        for (std::size_t i = 0; i < listHandles; ++i)
+            if (estimate.listCapacity[i] > 0)
+            {
+                if (!arrays[i].storage)
+                    arrays[i].storage = std::make_shared<std::vector<unsigned int>>();
+                arrays[i].storage->reserve(estimate.listCapacity[i]);
+            }
+
+        if (realTime)
+        {
+            if (!estimate.exact)
+            {
+                std::cerr << "Error: Real-time mode needs every List size to be known before the program runs." << std::endl;
+                if (!resultsPath.empty())
+                    recordResults(job, EXIT_FAILURE, 0);
+                return EXIT_FAILURE;
+            }
+
+            // Size the output buffers from the estimate
+            outputs.reserve(estimate.outputs);
+            histogramCounts.reserve(estimate.histogramScratch);
+
+            // Touch every buffer so no page faults are left for the run
+            for (auto &list : arrays)
+                if (list.storage)
+                {
+                    list.storage->resize(list.storage->capacity());
+                    list.storage->clear();
+                }
+            outputs.resize(outputs.capacity());
+            outputs.clear();
+            histogramCounts.resize(histogramCounts.capacity());
+            histogramCounts.clear();
+
+            // Lock only what is mapped now; locking future pages too would make
+            // later allocations fail once RLIMIT_MEMLOCK is reached
+            if (lockMemory && mlockall(MCL_CURRENT) != 0)
+            {
+                std::cerr << "Warning: Could not lock memory; running without mlockall." << std::endl;
+                lockMemory = false;
+            }
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        std::cerr << "Error: Not enough memory to preallocate the program's Lists." << std::endl;
+        if (!resultsPath.empty())
+            recordResults(job, EXIT_FAILURE, 0);
+        return EXIT_FAILURE;
+    }
+
+    // Begin execution
+    int status = EXIT_SUCCESS;
+    std::uint64_t executed{0};
+    allocations = 0;
+    for (auto it = memory.begin(); it != memory.end() && status == EXIT_SUCCESS; ++it, ++executed)
+    {
+        try
+        {
+            if (!execute(*it))
+                status = EXIT_FAILURE;
+            else if (realTime && allocations != 0)
+            {
+                std::cerr << "Error: Instruction \'" << *it << "\' allocated memory in real-time mode." << std::endl;
+                status = EXIT_FAILURE;
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            std::cerr << "Error: Instruction \'" << *it << "\' ran out of memory." << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    // Print what real-time mode held back
+    if (realTime)
+    {
+        for (std::size_t i = 0; !ring && i < outputs.size(); ++i)
+            std::cout << outputs[i] << '\n';
+        for (std::size_t i = 0; i < stops; ++i)
+            std::cout << "Program ended successfully.\n";
+    }
+
+    if (!resultsPath.empty())
+        recordResults(job, status, executed);
+    return status;
+}
+
+void roofline()
+{
+    using namespace global;
+
+    const std::size_t smallest = 1024;            // Elements in the smallest List, 4 KiB
+    const std::size_t largest = 64 * 1024 * 1024; // Elements in the largest List, 256 MiB
+    std::vector<unsigned int> list(largest);
+    std::vector<unsigned int> copy(largest);
+    std::vector<unsigned int> buckets(256);
+    listRandom(list.data(), list.size(), 1);
+    listFill(copy.data(), copy.size(), 0);
+
+    volatile unsigned int sink{0}; // Keeps results alive so kernels are not optimized away
+    struct Kernel
+    {
+        const char *name;
+        double ops;   // Operations per element
+        double bytes; // Bytes moved per element
+        void (*run)(std::vector<unsigned int> &, std::size_t, std::vector<unsigned int> &, volatile unsigned int &);
+    };
+    // ListSum adds each element it reads. ListFill only stores, and ListIota
+    // does a multiply and an add per store. ListRandom runs SplitMix64: a
+    // counter add, two xor-shift-multiply rounds, a last xor-shift and the
+    // shift to the upper half. ListHistogram divides, clamps and increments a
+    // bucket; the buckets stay in L1, so only the element read is traffic.
+    const Kernel kernels[] = {
+        {"ListSum", 1, 4, [](std::vector<unsigned int> &l, std::size_t n, std::vector<unsigned int> &, volatile unsigned int &out)
+         { out = listSum(l.data(), n); }},
+        {"ListFill", 0, 8, [](std::vector<unsigned int> &l, std::size_t n, std::vector<unsigned int> &, volatile unsigned int &out)
+         { listFill(l.data(), n, out); }},
+        {"ListIota", 2, 8, [](std::vector<unsigned int> &l, std::size_t n, std::vector<unsigned int> &, volatile unsigned int &out)
+         { listIota(l.data(), n, out, 3); }},
+        {"ListRandom", 10, 8, [](std::vector<unsigned int> &l, std::size_t n, std::vector<unsigned int> &, volatile unsigned int &out)
+         { listRandom(l.data(), n, out); }},
+        {"ListHistogram", 3, 4, [](std::vector<unsigned int> &l, std::size_t n, std::vector<unsigned int> &b, volatile unsigned int &)
+         { listHistogram(l.data(), n, b.data(), b.size(), 1u << 24); }},
+    };
+
+    // Peak compute: shift-adds on eight independent 4-lane vectors, named one
+    // by one so they stay in SSE registers; an array of them would be kept on
+    // the stack and each round would time loads and stores instead
+    typedef unsigned int Lanes __attribute__((vector_size(16)));
+    const std::size_t lanes = 8 * 4, rounds = 1 << 14;
+    auto shiftAdds = [&]()
+    {
+        Lanes a = Lanes{0, 1, 2, 3} + static_cast<unsigned int>(sink);
+        Lanes b = a + 4u, c = a + 8u, d = a + 12u, e = a + 16u, f = a + 20u, g = a + 24u, h = a + 28u;
+        for (std::size_t round = 0; round < rounds; ++round)
+        {
+            a += a >> 3;
+            b += b >> 3;
+            c += c >> 3;
+            d += d >> 3;
+            e += e >> 3;
+            f += f >> 3;
+            g += g >> 3;
+            h += h >> 3;
+        }
+        Lanes total = a + b + c + d + e + f + g + h;
+        sink = total[0] + total[1] + total[2] + total[3];
+    };
+    double peakOps = 2.0 * lanes * rounds / timeKernel(shiftAdds);
+
+    // Peak bandwidth at each size: memcpy reads and writes every byte once
+    std::vector<double> peakBandwidth;
+    for (std::size_t size = smallest; size <= largest; size *= 4)
+    {
+        double seconds = timeKernel([&]() { std::memcpy(copy.data(), list.data(), size * sizeof(unsigned int)); });
+        peakBandwidth.push_back(2 * size * sizeof(unsigned int) / seconds);
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Peak compute:   " << peakOps / 1e9 << " Gop/s (integer shift-add)\n"
+              << "Peak bandwidth: " << peakBandwidth.front() / 1e9 << " GB/s at 4 KiB, "
+              << peakBandwidth.back() / 1e9 << " GB/s at 256 MiB (memcpy)\n"
+              << "\n"
+              << std::left << std::setw(15) << "Kernel" << std::right << std::setw(9) << "Op/byte" << std::setw(12) << "Size (KiB)"
+              << std::setw(10) << "GB/s" << std::setw(10) << "Gop/s" << std::setw(12) << "Roof GB/s"
+              << std::setw(12) << "Roofline" << std::setw(9) << "Bound" << "\n";
+
+    for (const Kernel &kernel : kernels)
+    {
+        std::size_t level{0};
+        for (std::size_t size = smallest; size <= largest; size *= 4, ++level)
+        {
+            // Elements per second the kernel reached, and the most each roof allows
+            double elements = size / timeKernel([&]() { kernel.run(list, size, buckets, sink); });
+            double memoryBound = peakBandwidth[level] / kernel.bytes;
+            double computeBound = kernel.ops > 0 ? peakOps / kernel.ops : std::numeric_limits<double>::infinity();
+            std::cout << std::left << std::setw(15) << kernel.name << std::right
+                      << std::setw(9) << kernel.ops / kernel.bytes
+                      << std::setw(12) << size * sizeof(unsigned int) / 1024
+                      << std::setw(10) << elements * kernel.bytes / 1e9
+                      << std::setw(10) << elements * kernel.ops / 1e9
+                      << std::setw(12) << peakBandwidth[level] / 1e9
+                      << std::setw(11) << 100 * elements / std::min(memoryBound, computeBound) << "%"
+                      << std::setw(9) << (memoryBound < computeBound ? "memory" : "compute") << "\n";
+        }
+    }
+}
+
+std::string cpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+        if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos)
+            return line.substr(line.find_first_not_of(" \t", line.find(':') + 1));
+    return "unknown";
+}
+
+std::string tuningPath()
+{
+    const char *home = std::getenv("HOME");
+    return home ? std::string(home) + "/.clobos-tuning" : ".clobos-tuning";
+}
+
+void loadTuning()
+{
+    using namespace global;
+
+    std::ifstream file(tuningPath());
+    if (file.fail())
+        return;
+
+    std::string model = cpuModel();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string name;
+        std::size_t copies, limit;
+        if (std::getline(fields, name, '\t') && name == model && fields >> copies >> limit)
+        {
+            histogramCopies = copies;
+            histogramCopyLimit = limit;
+        }
+    }
+}
+
+bool calibrate()
+{
+    using namespace global;
+
+    const std::size_t size = 1 << 20;
+    const std::size_t copyCounts[] = {1, 2, 4, 8};
+    const std::size_t bucketCounts[] = {16, 64, 256, 1024, 4096, 16384};
+
+    // Uniform data spreads over every bucket; skewed data puts 7 of every 8
+    // values in the same bucket, which is where private copies pay off
+    std::vector<unsigned int> uniform(size), skewed(size), buckets(bucketCounts[5]);
+    listRandom(uniform.data(), size, 1);
+    for (std::size_t i = 0; i < size; ++i)
+        skewed[i] = i % 8 == 0 ? uniform[i] : 0;
+
+    std::cout << std::fixed << std::setprecision(2) << "Calibrating for " << cpuModel() << "\n\n"
+              << std::setw(8) << "Buckets";
+    for (std::size_t copies : copyCounts)
+        std::cout << std::setw(10) << copies << (copies == 1 ? " copy " : " copies");
+    std::cout << "  (ms per 2 x 1M values)\n";
+
+    // seconds[b][c] is the time for bucketCounts[b] buckets with copyCounts[c] copies
+    std::vector<std::vector<double>> seconds;
+    histogramCopyLimit = bucketCounts[5];
+    for (std::size_t count : bucketCounts)
+    {
+        const unsigned int width = static_cast<unsigned int>((1ull << 32) / count);
+        seconds.emplace_back();
+        std::cout << std::setw(8) << count;
+        for (std::size_t copies : copyCounts)
+        {
+            histogramCopies = copies;
+            seconds.back().push_back(timeKernel([&]() { listHistogram(uniform.data(), size, buckets.data(), count, width); }) +
+                                     timeKernel([&]() { listHistogram(skewed.data(), size, buckets.data(), count, width); }));
+            std::cout << std::setw(16) << seconds.back().back() * 1e3;
+        }
+        std::cout << "\n";
+    }
+
+    // Keep the copy count that is fastest relative to a single copy overall,
+    // and use it for every bucket count up to the first one where it loses.
+    // A single copy scores seconds.size(), so another count has to beat it.
+    std::size_t best{0};
+    double bestRatio = static_cast<double>(seconds.size());
+    for (std::size_t c = 1; c < 4; ++c)
+    {
+        double ratio{0};
+        for (const auto &row : seconds)
+            ratio += row[c] / row[0];
+        if (ratio < bestRatio)
+        {
+            best = c;
+            bestRatio = ratio;
+        }
+    }
+    histogramCopyLimit = 0;
+    for (std::size_t b = 0; b < seconds.size() && seconds[b][best] < seconds[b][0]; ++b)
+        histogramCopyLimit = bucketCounts[b];
+    histogramCopies = histogramCopyLimit > 0 ? copyCounts[best] : 1;
+
+    if (histogramCopies == 1)
+        std::cout << "\nListHistogram: 1 copy; no copy count beat it\n";
+    else
+        std::cout << "\nListHistogram: " << histogramCopies << " copies for up to " << histogramCopyLimit << " buckets\n";
+
+    // Replace this model's profile, keeping the others
+    std::string model = cpuModel();
+    std::string path = tuningPath();
+    std::vector<std::string> profiles;
+    std::ifstream existing(path);
+    for (std::string line; std::getline(existing, line);)
+        if (line.compare(0, model.size() + 1, model + "\t") != 0)
+            profiles.push_back(line);
+    existing.close();
+    profiles.push_back(model + "\t" + std::to_string(histogramCopies) + "\t" + std::to_string(histogramCopyLimit));
+
+    std::ofstream file(path);
+    for (const std::string &profile : profiles)
+        file << profile << "\n";
+    if (file.fail())
+    {
+        std::cerr << "Error: Could not write tuning profile \'" << path << "\'." << std::endl;
+        return false;
+    }
+    std::cout << "Saved the profile to " << path << "\n";
+    return true;
+}
+
+bool execute(const std::string &ins)
+{
+    using namespace global;
+
+    instruction = ins;
+    opcode = instruction.substr(0, 5);
+
+    if (binaryToDecimal(opcode) == Opcode::Stop)
+    {
+        if (realTime)
+            ++stops;
+        else
+            std::cout << "Program ended successfully.\n";
+    }
+    else if (binaryToDecimal(opcode) == 1)
+    {
+        if (!(realTime || rawInput))
+            std::cout << "Enter a value: ";
+        unsigned int value = readValue();
+
+        std::string destination = instruction.substr(5, 2);
+
+        if (!validRegister(destination))
+            return false;
+
+        registers[destination] = value;
+    }
+    else if (binaryToDecimal(opcode) == Opcode::Out)
+    {
+        auto source = instruction.substr(5, 2);
+
+        if (!validRegister(source))
+            return false;
+
+        writeValue(registers[source]);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::Incr)
+    {
+        auto amount = binaryToDecimal(instruction.substr(5, 6));
+        auto source = instruction.substr(11);
+
+        if (!validRegister(source))
+            return false;
+
+        registers[source] += amount;
+    }
+    else if (binaryToDecimal(opcode) == Opcode::Add)
+    {
+        std::string lhs, rhs, destination;
+        lhs = instruction.substr(5, 2);
+        rhs = instruction.substr(7, 2);
+        destination = instruction.substr(9, 2);
+
+        if (!validRegister(destination))
+            return false;
+
+        registers[destination] = registers[lhs] + registers[rhs];
+    }
+    else if (binaryToDecimal(opcode) == Opcode::Sub)
+    {
+        std::string lhs, rhs, destination;
+        lhs = instruction.substr(5, 2);
+        rhs = instruction.substr(7, 2);
+        destination = instruction.substr(9, 2);
+
+        if (!validRegister(destination))
+            return false;
+
+        registers[destination] = registers[lhs] - registers[rhs];
+    }
+    else if (binaryToDecimal(opcode) == Opcode::Mul)
+    {
+        std::string lhs, rhs, destination;
+        lhs = instruction.substr(5, 2);
+        rhs = instruction.substr(7, 2);
+        destination = instruction.substr(9, 2);
+
+        if (!validRegister(destination))
+            return false;
+
+        registers[destination] = registers[lhs] * registers[rhs];
+    }
+    else if (binaryToDecimal(opcode) == Opcode::List)
+    {
+        std::size_t amount;
+        if (instruction.substr(7, 4) == "0000") // Size is in a register
+        {
+            auto registerAddress = instruction.substr(5, 2);
+
+            if (!validRegister(registerAddress))
+                return false;
+
+            amount = registers[registerAddress];
+        }
+        else // Size is a literal
+            amount = static_cast<std::size_t>(binaryToDecimal(instruction.substr(5, 6)));
+        auto source = instruction.substr(11);
+
+        if (!validRegister(source))
+            return false;
+
+        auto &list = listHandle(source);
+        if (list.storage && list.storage.use_count() == 1) // No other handle sees it, so reuse it
+            list.storage->assign(amount, 0);
+        else if (amount == 0) // Nothing to hold, and nothing preallocated for it in real-time mode
+            list.storage.reset();
+        else
+            list.storage = std::make_shared<std::vector<unsigned int>>(amount);
+        list.offset = 0;
+        list.size = amount;
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListInit)
+    {
+        auto source = instruction.substr(5, 2);
+
+        if (!validRegister(source))
+            return false;
+
+        auto &list = listHandle(source);
+        if (realTime) // Copy the values read up front
+        {
+            std::size_t available = std::min(list.size, inputs.size() - nextInput);
+            std::copy(inputs.begin() + nextInput, inputs.begin() + nextInput + available, list.data());
+            std::fill(list.data() + available, list.data() + list.size, 0u);
+            nextInput += available;
+        }
+        else if (rawInput)
+            readRaw(list.data(), list.size);
+        else
+            for (std::size_t i = 0; i < list.size; ++i)
+            {
+                std::cout << "Enter value for index " << i << ": ";
+                list.data()[i] = readValue();
+            }
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListSum)
+    {
+        auto source = instruction.substr(5, 2);
+        auto destination = instruction.substr(7, 2);
+
+        if (!(validRegister(source) && validRegister(destination)))
+            return false;
+
+        const auto &array = listHandle(source);
+        registers[destination] = listSum(array.data(), array.size);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::TidyUp)
+    {
+        for (auto &reg : registers)
+            reg.second = 0;
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListFill)
+    {
+        auto source = instruction.substr(5, 2);
+        auto value = instruction.substr(7, 2);
+
+        if (!(validRegister(source) && validRegister(value)))
+            return false;
+
+        auto &array = listHandle(source);
+        listFill(array.data(), array.size, registers[value]);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListIota)
+    {
+        auto source = instruction.substr(5, 2);
+        auto start = instruction.substr(7, 2);
+        auto step = instruction.substr(9, 2);
+
+        if (!(validRegister(source) && validRegister(start) && validRegister(step)))
+            return false;
+
+        auto &array = listHandle(source);
+        listIota(array.data(), array.size, registers[start], registers[step]);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListRandom)
+    {
+        auto source = instruction.substr(5, 2);
+        auto seed = instruction.substr(7, 2);
+
+        if (!(validRegister(source) && validRegister(seed)))
+            return false;
+
+        auto &array = listHandle(source);
+        listRandom(array.data(), array.size, registers[seed]);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListSlice)
+    {
+        auto destination = instruction.substr(5, 2);
+        auto source = instruction.substr(7, 2);
+        auto start = instruction.substr(9, 2);
+        auto amount = instruction.substr(11);
+
+        if (!(validRegister(destination) && validRegister(source) && validRegister(start) && validRegister(amount)))
+            return false;
+
+        ListHandle slice = listHandle(source);
+        if (registers[start] > slice.size || registers[amount] > slice.size - registers[start])
+        {
+            std::cerr << "Error: Slice [" << registers[start] << ", " << registers[start] + registers[amount]
+                      << ") is out of range for a List of size " << slice.size << ".\n";
+            return false;
+        }
+        slice.offset += registers[start];
+        slice.size = registers[amount];
+        listHandle(destination) = slice;
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListView)
+    {
+        auto destination = instruction.substr(5, 2);
+        auto source = instruction.substr(7, 2);
+
+        if (!(validRegister(destination) && validRegister(source)))
+            return false;
+
+        listHandle(destination) = listHandle(source);
+    }
+    else if (binaryToDecimal(opcode) == Opcode::ListBank)
+        listBank = binaryToDecimal(instruction.substr(5, 6));
+    else if (binaryToDecimal(opcode) == Opcode::ListHistogram)
+    {
+        auto source = instruction.substr(5, 2);
+        auto destination = instruction.substr(7, 2);
+        auto width = instruction.substr(9, 2);
+
+        if (!(validRegister(source) && validRegister(destination) && validRegister(width)))
+            return false;
+
+        const auto &array = listHandle(source);
+        auto &histogram = listHandle(destination);
+        listHistogram(array.data(), array.size, histogram.data(), histogram.size, registers[width]);
+    }
+    return true;
+}